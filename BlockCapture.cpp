@@ -0,0 +1,448 @@
+/*
+  ==============================================================================
+
+    BlockCapture.cpp
+    Created: 19 Oct 2026 11:40:21am
+
+  ==============================================================================
+*/
+
+#include "BlockCapture.h"
+
+namespace
+{
+    //Escreve bytes seguidos nas duas zonas devolvidas pelo AbstractFifo::prepareToWrite
+    struct FifoWriter
+    {
+        char* block1;
+        int size1;
+        char* block2;
+        int pos = 0;
+
+        void write(const void* src, int numBytes)
+        {
+            auto* bytes = static_cast<const char*>(src);
+            const int first = juce::jlimit(0, numBytes, size1 - pos);
+
+            if (first > 0)
+                memcpy(block1 + pos, bytes, (size_t)first);
+
+            if (numBytes > first)
+                memcpy(block2 + (pos + first - size1), bytes + first, (size_t)(numBytes - first));
+
+            pos += numBytes;
+        }
+    };
+
+    void readFromFifo(const juce::AbstractFifo& fifo, const std::vector<char>& fifoData, char* dest, int numBytes)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numBytes, start1, size1, start2, size2);
+
+        memcpy(dest, fifoData.data() + start1, (size_t)size1);
+
+        if (size2 > 0)
+            memcpy(dest + size1, fifoData.data() + start2, (size_t)size2);
+    }
+}
+
+//==============================================================================
+BlockCapture::BlockCapture()
+    : juce::Thread("KeblexComp block capture")
+{
+}
+
+BlockCapture::~BlockCapture()
+{
+    stop();
+}
+
+juce::int64 BlockCapture::getRecordSize(int numChannels, int numSamples, int numStates)
+{
+    const juce::int64 size = (juce::int64)sizeof(RecordHeader)
+                           + (juce::int64)numStates * (juce::int64)sizeof(ChannelCompState)
+                           + (juce::int64)numChannels * numSamples * (juce::int64)sizeof(float);
+
+    return (size + 7) & ~(juce::int64)7; //Mantém os registos alinhados a 8 bytes
+}
+
+bool BlockCapture::start(const juce::File& file, juce::int64 ringSizeBytes, double sampleRate, int numChannels, int maxBlockSize)
+{
+    stop();
+
+    const juce::int64 maxRecordSize = getRecordSize(numChannels, juce::jmax(1, maxBlockSize), numChannels);
+    ringSizeBytes = juce::jmax(ringSizeBytes, maxRecordSize * 4);
+
+    //Pré-alocar o ficheiro inteiro aqui, fora do audio thread
+    file.deleteFile();
+
+    {
+        juce::FileOutputStream out(file);
+
+        if (out.failedToOpen())
+            return false;
+
+        juce::HeapBlock<char> zeros(65536, true);
+
+        for (juce::int64 remaining = dataStart + ringSizeBytes; remaining > 0; remaining -= 65536)
+        {
+            if (! out.write(zeros, (size_t)juce::jmin(remaining, (juce::int64)65536)))
+                return false;
+        }
+    }
+
+    mappedFile = std::make_unique<juce::MemoryMappedFile>(file, juce::Range<juce::int64>(0, dataStart + ringSizeBytes),
+                                                          juce::MemoryMappedFile::readWrite);
+
+    if (mappedFile->getData() == nullptr)
+    {
+        mappedFile.reset();
+        return false;
+    }
+
+    header = {};
+    header.magic = fileMagic;
+    header.version = formatVersion;
+    header.sampleRate = sampleRate;
+    header.numChannels = (juce::uint32)numChannels;
+    header.maxBlockSize = (juce::uint32)maxBlockSize;
+    header.ringSize = ringSizeBytes;
+    updateFileHeader();
+
+    //O FIFO tem de aguentar vários blocos enquanto a thread de fundo não o esvazia
+    const int fifoSize = (int)juce::jmax((juce::int64)(1 << 22), maxRecordSize * 32);
+    fifoData.assign((size_t)fifoSize, 0);
+    fifo = std::make_unique<juce::AbstractFifo>(fifoSize);
+    scratch.assign((size_t)maxRecordSize, 0);
+    maxRecordSamples = juce::jmax(1, maxBlockSize);
+
+    nextBlockIndex = 0;
+    droppedBlocks = 0;
+
+    startThread();
+
+    const juce::SpinLock::ScopedLockType sl(captureLock);
+    capturing = true;
+    return true;
+}
+
+void BlockCapture::stop()
+{
+    {
+        const juce::SpinLock::ScopedLockType sl(captureLock);
+
+        if (! capturing.load())
+            return;
+
+        capturing = false;
+    }
+
+    //A thread esvazia o que ainda estiver no FIFO antes de sair
+    stopThread(5000);
+
+    header.droppedBlocks = droppedBlocks.load();
+    updateFileHeader();
+
+    mappedFile.reset();
+    fifo.reset();
+}
+
+void BlockCapture::pushBlock(const juce::AudioBuffer<float>& input, const CompressorParams& params,
+                             const ChannelCompState* states, int numStates, bool nonRealtime)
+{
+    //Nunca bloquear o audio thread: se o start/stop estiver a decorrer, este bloco perde-se
+    const juce::SpinLock::ScopedTryLockType tl(captureLock);
+
+    if (! tl.isLocked() || ! capturing.load())
+        return;
+
+    const int numChannels = input.getNumChannels();
+    const int numSamples = input.getNumSamples();
+    const juce::int64 blockIndex = nextBlockIndex++;
+
+    //Blocos maiores do que o tamanho preparado são divididos em vários registos
+    const int numPieces = juce::jmax(1, (numSamples + maxRecordSamples - 1) / maxRecordSamples);
+    juce::int64 totalSize = 0;
+
+    for (int piece = 0; piece < numPieces; ++piece)
+    {
+        const int pieceSamples = juce::jmin(maxRecordSamples, numSamples - piece * maxRecordSamples);
+        totalSize += getRecordSize(numChannels, juce::jmax(0, pieceSamples), piece == 0 ? numStates : 0);
+    }
+
+    //Todos os registos do bloco entram no FIFO de uma vez, ou nenhum
+    int start1, size1, start2, size2;
+    fifo->prepareToWrite((int)juce::jmin(totalSize, (juce::int64)std::numeric_limits<int>::max()), start1, size1, start2, size2);
+
+    if ((juce::int64)(size1 + size2) < totalSize)
+    {
+        ++droppedBlocks;
+        return;
+    }
+
+    FifoWriter writer { fifoData.data() + start1, size1, fifoData.data() + start2 };
+
+    for (int piece = 0; piece < numPieces; ++piece)
+    {
+        const int pieceStart = piece * maxRecordSamples;
+        const int pieceSamples = juce::jmax(0, juce::jmin(maxRecordSamples, numSamples - pieceStart));
+        const int pieceStates = (piece == 0) ? numStates : 0;
+        const juce::int64 recordSize = getRecordSize(numChannels, pieceSamples, pieceStates);
+
+        RecordHeader rec {};
+        rec.magic = recordMagic;
+        rec.totalBytes = (juce::uint32)recordSize;
+        rec.blockIndex = blockIndex;
+        rec.numChannels = (juce::uint32)numChannels;
+        rec.numSamples = (juce::uint32)pieceSamples;
+        rec.numStates = (juce::uint32)pieceStates;
+        rec.nonRealtime = nonRealtime ? 1 : 0;
+        rec.continuation = (piece > 0) ? 1 : 0;
+        rec.params = params;
+
+        const int startPos = writer.pos;
+        writer.write(&rec, (int)sizeof(rec));
+        writer.write(states, pieceStates * (int)sizeof(ChannelCompState));
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            writer.write(input.getReadPointer(ch, pieceStart), pieceSamples * (int)sizeof(float));
+
+        writer.pos = startPos + (int)recordSize; //Salta o enchimento de alinhamento
+    }
+
+    fifo->finishedWrite((int)totalSize);
+}
+
+//==============================================================================
+void BlockCapture::run()
+{
+    while (! threadShouldExit())
+    {
+        wait(10);
+        drainFifo();
+    }
+
+    drainFifo();
+}
+
+void BlockCapture::drainFifo()
+{
+    //O audio thread só faz finishedWrite com o registo completo, por isso um cabeçalho pronto implica o registo inteiro
+    while (fifo->getNumReady() >= (int)sizeof(RecordHeader))
+    {
+        RecordHeader rec;
+        readFromFifo(*fifo, fifoData, reinterpret_cast<char*>(&rec), (int)sizeof(rec));
+
+        readFromFifo(*fifo, fifoData, scratch.data(), (int)rec.totalBytes);
+        fifo->finishedRead((int)rec.totalBytes);
+
+        writeRecord(scratch.data(), rec.totalBytes);
+    }
+
+    header.droppedBlocks = droppedBlocks.load();
+    updateFileHeader();
+}
+
+void BlockCapture::writeRecord(const char* data, juce::int64 numBytes)
+{
+    auto* ring = static_cast<char*>(mappedFile->getData()) + dataStart;
+
+    //Não cabe até ao fim do anel: recomeça do início e a volta anterior passa a ser a mais antiga
+    if (header.writeOffset + numBytes > header.ringSize)
+    {
+        header.lapEnd = header.writeOffset;
+        header.oldestOffset = 0;
+        header.writeOffset = 0;
+    }
+
+    //Avança o registo mais antigo para lá dos que vão ser escritos por cima
+    while (header.lapEnd > 0
+        && header.oldestOffset < header.lapEnd
+        && header.oldestOffset < header.writeOffset + numBytes)
+    {
+        auto* old = reinterpret_cast<const RecordHeader*>(ring + header.oldestOffset);
+
+        if (old->magic != recordMagic || old->totalBytes == 0)
+        {
+            header.oldestOffset = header.lapEnd;
+            break;
+        }
+
+        header.oldestOffset += old->totalBytes;
+    }
+
+    memcpy(ring + header.writeOffset, data, (size_t)numBytes);
+    header.writeOffset += numBytes;
+}
+
+void BlockCapture::updateFileHeader()
+{
+    if (mappedFile != nullptr)
+        memcpy(mappedFile->getData(), &header, sizeof(header));
+}
+
+//==============================================================================
+bool CaptureReplayer::open(const juce::File& file)
+{
+    recordOffsets.clear();
+    blocks.clear();
+    mappedFile = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+    if (mappedFile->getData() == nullptr || mappedFile->getSize() < (size_t)BlockCapture::dataStart)
+        return false;
+
+    memcpy(&header, mappedFile->getData(), sizeof(header));
+
+    if (header.magic != BlockCapture::fileMagic || header.version != BlockCapture::formatVersion
+        || (juce::int64)mappedFile->getSize() < BlockCapture::dataStart + header.ringSize)
+        return false;
+
+    //Primeiro o que resta da volta anterior, depois a volta atual
+    if (header.lapEnd > 0 && ! addRecordsInRange(header.oldestOffset, header.lapEnd))
+        return false;
+
+    if (! addRecordsInRange(0, header.writeOffset))
+        return false;
+
+    groupRecordsIntoBlocks();
+    return true;
+}
+
+void CaptureReplayer::groupRecordsIntoBlocks()
+{
+    blocks.clear();
+    maxReplayBlockSize = 0;
+    numMissingBlocks = 0;
+
+    juce::int64 lastBlockIndex = -1;
+
+    for (int i = 0; i < (int)recordOffsets.size(); ++i)
+    {
+        auto* rec = getRecord(i);
+
+        if (rec->continuation != 0)
+        {
+            //Continuação cujo primeiro registo o anel já substituiu: não dá para reproduzir
+            if (blocks.empty() || lastBlockIndex != rec->blockIndex)
+                continue;
+
+            auto& block = blocks.back();
+            ++block.numRecords;
+            block.numSamples += (int)rec->numSamples;
+        }
+        else
+        {
+            if (! blocks.empty() && rec->blockIndex > lastBlockIndex + 1)
+                numMissingBlocks += rec->blockIndex - lastBlockIndex - 1;
+
+            blocks.push_back({ i, 1, (int)rec->numSamples });
+            lastBlockIndex = rec->blockIndex;
+        }
+
+        maxReplayBlockSize = juce::jmax(maxReplayBlockSize, blocks.back().numSamples);
+    }
+}
+
+bool CaptureReplayer::addRecordsInRange(juce::int64 start, juce::int64 end)
+{
+    auto* ring = static_cast<const char*>(mappedFile->getData()) + BlockCapture::dataStart;
+
+    for (juce::int64 offset = start; offset < end;)
+    {
+        auto* rec = reinterpret_cast<const BlockCapture::RecordHeader*>(ring + offset);
+
+        if (offset + (juce::int64)sizeof(BlockCapture::RecordHeader) > end
+            || rec->magic != BlockCapture::recordMagic
+            || offset + rec->totalBytes > end
+            || rec->totalBytes < BlockCapture::getRecordSize((int)rec->numChannels, (int)rec->numSamples, (int)rec->numStates))
+            return false;
+
+        recordOffsets.push_back(offset);
+        offset += rec->totalBytes;
+    }
+
+    return true;
+}
+
+const BlockCapture::RecordHeader* CaptureReplayer::getRecord(int index) const
+{
+    auto* ring = static_cast<const char*>(mappedFile->getData()) + BlockCapture::dataStart;
+    return reinterpret_cast<const BlockCapture::RecordHeader*>(ring + recordOffsets[(size_t)index]);
+}
+
+void CaptureReplayer::replay(KeblexCompAudioProcessor& processor, juce::AudioBuffer<float>* output) const
+{
+    const int numChannels = getNumChannels();
+    const int maxBlockSize = juce::jmax(1, getMaxBlockSize());
+
+    //O modo nonRealtime tem de estar certo antes do prepareToPlay, porque é aí que o processador decide se cria a pool
+    bool nonRealtime = ! blocks.empty() && getRecord(blocks.front().firstRecord)->nonRealtime != 0;
+
+    processor.setPlayConfigDetails(numChannels, numChannels, getSampleRate(), maxBlockSize);
+    processor.setNonRealtime(nonRealtime);
+    processor.prepareToPlay(getSampleRate(), maxBlockSize);
+
+    //Os blocos do host podem ser maiores do que o tamanho preparado, tal como na captura
+    juce::AudioBuffer<float> buffer(numChannels, juce::jmax(1, maxReplayBlockSize));
+    juce::MidiBuffer midi;
+
+    if (output != nullptr)
+    {
+        int totalSamples = 0;
+
+        for (auto& block : blocks)
+            totalSamples += block.numSamples;
+
+        output->setSize(numChannels, totalSamples);
+    }
+
+    int outPos = 0;
+
+    for (auto& block : blocks)
+    {
+        auto* first = getRecord(block.firstRecord);
+
+        if ((first->nonRealtime != 0) != nonRealtime)
+        {
+            nonRealtime = ! nonRealtime;
+            processor.setNonRealtime(nonRealtime);
+            processor.prepareToPlay(getSampleRate(), maxBlockSize);
+        }
+
+        //Repor exatamente o estado que o processador tinha no início do bloco gravado (depois de um eventual prepareToPlay)
+        auto* states = reinterpret_cast<const ChannelCompState*>(first + 1);
+        processor.setCurrentParams(first->params);
+
+        for (int ch = 0; ch < (int)first->numStates; ++ch)
+            processor.setChannelState(ch, states[ch]);
+
+        buffer.setSize(numChannels, block.numSamples, false, false, true);
+        buffer.clear();
+
+        int piecePos = 0;
+
+        for (int r = block.firstRecord; r < block.firstRecord + block.numRecords; ++r)
+        {
+            auto* rec = getRecord(r);
+            auto* samples = reinterpret_cast<const float*>(reinterpret_cast<const ChannelCompState*>(rec + 1) + rec->numStates);
+
+            const int blockChannels = juce::jmin((int)rec->numChannels, numChannels);
+            const int numSamples = (int)rec->numSamples;
+
+            for (int ch = 0; ch < blockChannels; ++ch)
+                memcpy(buffer.getWritePointer(ch, piecePos), samples + (size_t)ch * (size_t)numSamples, (size_t)numSamples * sizeof(float));
+
+            piecePos += numSamples;
+        }
+
+        processor.processBlock(buffer, midi);
+
+        if (output != nullptr)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                output->copyFrom(ch, outPos, buffer, ch, 0, block.numSamples);
+
+            outPos += block.numSamples;
+        }
+    }
+}
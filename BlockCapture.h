@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    BlockCapture.h
+    Created: 19 Oct 2026 11:40:21am
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    Grava os blocos de entrada do processBlock (com os parâmetros e o estado
+    de cada canal no início do bloco) num ficheiro em anel mapeado em memória.
+
+    O audio thread só copia o bloco para um FIFO pré-alocado; é uma thread de
+    fundo que passa os registos para o ficheiro, por isso o audio thread nunca
+    faz I/O nem aloca memória. Quando o anel enche, os blocos mais antigos são
+    substituídos. Se o FIFO estiver cheio o bloco é descartado e contado.
+
+    Blocos do host maiores do que o tamanho do prepareToPlay são gravados em
+    vários registos (o primeiro com o estado, os outros marcados como
+    continuação) e voltam a ser juntos num só bloco na reprodução.
+*/
+class BlockCapture : private juce::Thread
+{
+public:
+    BlockCapture();
+    ~BlockCapture() override;
+
+    bool start(const juce::File& file, juce::int64 ringSizeBytes, double sampleRate, int numChannels, int maxBlockSize);
+    void stop();
+    bool isCapturing() const { return capturing.load(); }
+
+    //Chamado pelo audio thread
+    void pushBlock(const juce::AudioBuffer<float>& input, const CompressorParams& params,
+                   const ChannelCompState* states, int numStates, bool nonRealtime);
+
+    juce::int64 getNumDroppedBlocks() const { return droppedBlocks.load(); }
+
+    //==============================================================================
+    struct FileHeader
+    {
+        juce::uint32 magic;
+        juce::uint32 version;
+        double sampleRate;
+        juce::uint32 numChannels;
+        juce::uint32 maxBlockSize;
+        juce::int64 ringSize;      //Tamanho da zona de dados (depois do cabeçalho)
+        juce::int64 writeOffset;   //Onde será escrito o próximo registo
+        juce::int64 oldestOffset;  //Primeiro registo ainda intacto da volta anterior
+        juce::int64 lapEnd;        //Fim da volta anterior (0 se o anel ainda não deu a volta)
+        juce::int64 droppedBlocks;
+    };
+
+    struct RecordHeader
+    {
+        juce::uint32 magic;
+        juce::uint32 totalBytes;   //Inclui este cabeçalho
+        juce::int64 blockIndex;    //Índice do bloco do host (conta também os descartados)
+        juce::uint32 numChannels;
+        juce::uint32 numSamples;
+        juce::uint32 numStates;    //0 nos registos de continuação
+        juce::uint32 nonRealtime;
+        juce::uint32 continuation; //1 = resto de um bloco do host maior do que maxBlockSize
+        juce::uint32 reserved;
+        CompressorParams params;
+        //Seguem-se numStates ChannelCompState e numChannels * numSamples floats
+    };
+
+    static constexpr juce::uint32 fileMagic = 0x4b424350;   //"KBCP"
+    static constexpr juce::uint32 recordMagic = 0x4b42424b; //"KBBK"
+    static constexpr juce::uint32 formatVersion = 5;
+    static constexpr juce::int64 dataStart = 4096;
+
+    static juce::int64 getRecordSize(int numChannels, int numSamples, int numStates);
+
+private:
+    void run() override;
+    void drainFifo();
+    void writeRecord(const char* data, juce::int64 numBytes);
+    void updateFileHeader();
+
+    juce::SpinLock captureLock;
+    std::atomic<bool> capturing { false };
+    std::atomic<juce::int64> droppedBlocks { 0 };
+    juce::int64 nextBlockIndex = 0;
+    int maxRecordSamples = 1;
+
+    std::vector<char> fifoData;
+    std::unique_ptr<juce::AbstractFifo> fifo;
+
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    FileHeader header {};
+    std::vector<char> scratch;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockCapture)
+};
+
+//==============================================================================
+/**
+    Lê um ficheiro gravado pelo BlockCapture e volta a passar exatamente a
+    mesma sequência de blocos pelo processador, para correr offline debaixo de
+    um profiler ou do benchmark.
+*/
+class CaptureReplayer
+{
+public:
+    bool open(const juce::File& file);
+
+    double getSampleRate() const { return header.sampleRate; }
+    int getNumChannels() const { return (int)header.numChannels; }
+    int getMaxBlockSize() const { return (int)header.maxBlockSize; }
+    int getNumBlocks() const { return (int)blocks.size(); }
+    int getMaxReplayBlockSize() const { return maxReplayBlockSize; }
+
+    //Blocos descartados durante a captura (FIFO cheio), incluindo os que o anel já substituiu
+    juce::int64 getNumDroppedBlocks() const { return header.droppedBlocks; }
+
+    //Blocos que faltam entre o primeiro e o último bloco reproduzidos (a reprodução salta por cima deles)
+    juce::int64 getNumMissingBlocks() const { return numMissingBlocks; }
+
+    //Prepara o processador com a configuração gravada e processa todos os blocos por ordem.
+    //Se output não for nullptr, as saídas de todos os blocos são concatenadas nele.
+    void replay(KeblexCompAudioProcessor& processor, juce::AudioBuffer<float>* output = nullptr) const;
+
+private:
+    const BlockCapture::RecordHeader* getRecord(int index) const;
+    bool addRecordsInRange(juce::int64 start, juce::int64 end);
+    void groupRecordsIntoBlocks();
+
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    BlockCapture::FileHeader header {};
+    std::vector<juce::int64> recordOffsets;
+
+    //Um bloco do host pode ocupar vários registos seguidos
+    struct ReplayBlock
+    {
+        int firstRecord, numRecords, numSamples;
+    };
+
+    std::vector<ReplayBlock> blocks;
+    int maxReplayBlockSize = 0;
+    juce::int64 numMissingBlocks = 0;
+};
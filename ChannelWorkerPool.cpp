@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.cpp
+    Created: 19 Oct 2026 9:12:04am
+
+  ==============================================================================
+*/
+
+#include "ChannelWorkerPool.h"
+
+ChannelWorkerPool::Worker::Worker (ChannelWorkerPool& p, int index)
+    : juce::Thread ("KeblexComp channel worker " + juce::String (index)), pool (p)
+{
+}
+
+void ChannelWorkerPool::Worker::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (-1); //Espera até o run() do pool acordar esta thread
+
+        if (threadShouldExit())
+            break;
+
+        pool.drainTasks();
+
+        if (--pool.workersPending == 0)
+            pool.allDone.signal();
+    }
+}
+
+//==============================================================================
+ChannelWorkerPool::ChannelWorkerPool (int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto* worker = workers.add (new Worker (*this, i));
+        worker->startThread();
+    }
+}
+
+ChannelWorkerPool::~ChannelWorkerPool()
+{
+    for (auto* worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->notify();
+    }
+
+    for (auto* worker : workers)
+        worker->stopThread (2000);
+}
+
+void ChannelWorkerPool::runTasks (int numTasks, void* context, TaskFunction function)
+{
+    if (numTasks <= 0)
+        return;
+
+    curContext = context;
+    curFunction = function;
+    numTasksToRun = numTasks;
+    nextTask = 0;
+
+    //Não vale a pena acordar mais threads do que tarefas (a thread atual também trabalha)
+    const int numToWake = juce::jmin (workers.size(), numTasks - 1);
+    workersPending = numToWake;
+
+    for (int i = 0; i < numToWake; ++i)
+        workers.getUnchecked (i)->notify();
+
+    drainTasks();
+
+    while (workersPending.load() > 0)
+        allDone.wait (-1);
+
+    curContext = nullptr;
+    curFunction = nullptr;
+}
+
+void ChannelWorkerPool::drainTasks()
+{
+    for (;;)
+    {
+        const int i = nextTask.fetch_add (1);
+
+        if (i >= numTasksToRun)
+            break;
+
+        curFunction (curContext, i);
+    }
+}
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.h
+    Created: 19 Oct 2026 9:12:04am
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <type_traits>
+
+//==============================================================================
+/**
+    Pequeno conjunto persistente de threads usado para processar canais em
+    paralelo nos renders offline. As threads são criadas uma vez e ficam à
+    espera entre blocos, por isso não há criação de threads no processBlock.
+*/
+class ChannelWorkerPool
+{
+public:
+    explicit ChannelWorkerPool (int numWorkers);
+    ~ChannelWorkerPool();
+
+    // Executa task(0) .. task(numTasks - 1) e só retorna quando todas acabarem.
+    // A thread que chama também participa no trabalho. A tarefa é passada por
+    // referência (sem std::function), por isso não há alocações por chamada.
+    template <typename Task>
+    void run (int numTasks, Task&& task)
+    {
+        using TaskType = std::remove_reference_t<Task>;
+
+        runTasks (numTasks, const_cast<void*> (static_cast<const void*> (&task)), [] (void* context, int index)
+        {
+            (*static_cast<TaskType*> (context)) (index);
+        });
+    }
+
+    int getNumWorkers() const { return workers.size(); }
+
+private:
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker (ChannelWorkerPool& p, int index);
+        void run() override;
+
+    private:
+        ChannelWorkerPool& pool;
+    };
+
+    using TaskFunction = void (*) (void* context, int index);
+
+    void runTasks (int numTasks, void* context, TaskFunction function);
+    void drainTasks();
+
+    juce::OwnedArray<Worker> workers;
+    juce::WaitableEvent allDone;
+
+    void* curContext = nullptr;
+    TaskFunction curFunction = nullptr;
+    int numTasksToRun = 0;
+    std::atomic<int> nextTask { 0 };
+    std::atomic<int> workersPending { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelWorkerPool)
+};
@@ -0,0 +1,373 @@
+/*
+  ==============================================================================
+
+    LoudnessAnalyser.cpp
+    Created: 19 Oct 2026 3:21:47pm
+
+  ==============================================================================
+*/
+
+#include "LoudnessAnalyser.h"
+#include <algorithm>
+
+namespace
+{
+    struct Biquad
+    {
+        double b0, b1, b2, a1, a2;
+        double z1 = 0.0, z2 = 0.0;
+
+        double process(double x)
+        {
+            const double y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    //Filtros K-weighting do BS.1770 (high shelf + high pass) recalculados para qualquer sample rate
+    void makeKWeighting(double sampleRate, Biquad& shelf, Biquad& highPass)
+    {
+        {
+            const double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+            const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+            const double vh = std::pow(10.0, gainDb / 20.0);
+            const double vb = std::pow(vh, 0.4996667741545416);
+            const double a0 = 1.0 + k / q + k * k;
+
+            shelf = { (vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                      2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+        }
+
+        {
+            const double f0 = 38.13547087602444, q = 0.5003270373238773;
+            const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+            const double a0 = 1.0 + k / q + k * k;
+
+            highPass = { 1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+        }
+    }
+
+    //Peso de cada canal: 5.1 segue o BS.1770 (LFE ignorado, surrounds +1.5 dB), o resto conta igual
+    double getChannelWeight(int ch, int numChannels)
+    {
+        if (numChannels == 6)
+        {
+            static const double weights[] = { 1.0, 1.0, 1.0, 0.0, 1.41, 1.41 };
+            return weights[ch];
+        }
+
+        return 1.0;
+    }
+
+    int getOversampling(double sampleRate)
+    {
+        return sampleRate < 96000.0 ? 4 : (sampleRate < 192000.0 ? 2 : 1);
+    }
+
+    constexpr int truePeakTapsPerPhase = 12;
+
+    //Filtro de interpolação (sinc com janela de Hann) dividido por fase
+    std::vector<float> makeInterpolationFilter(int oversampling)
+    {
+        const int numTaps = truePeakTapsPerPhase * oversampling;
+        std::vector<float> taps((size_t)numTaps);
+
+        for (int i = 0; i < numTaps; ++i)
+        {
+            const double t = (i - (numTaps - 1) * 0.5) / (double)oversampling;
+            const double sinc = (t == 0.0) ? 1.0 : std::sin(juce::MathConstants<double>::pi * t) / (juce::MathConstants<double>::pi * t);
+            const double window = 0.5 - 0.5 * std::cos(2.0 * juce::MathConstants<double>::pi * (i + 0.5) / numTaps);
+            taps[(size_t)i] = (float)(sinc * window);
+        }
+
+        return taps;
+    }
+
+    double percentile(const std::vector<double>& sorted, double fraction)
+    {
+        const size_t index = (size_t)juce::jlimit(0.0, (double)sorted.size() - 1.0, std::round(fraction * (double)(sorted.size() - 1)));
+        return sorted[index];
+    }
+}
+
+//==============================================================================
+LoudnessAnalyser::LoudnessAnalyser(int numSubBlocksPerChunk)
+    : subBlocksPerChunk(juce::jmax(1, numSubBlocksPerChunk)),
+      pool(juce::jlimit(0, 15, juce::SystemStats::getNumCpus() - 1))
+{
+}
+
+LoudnessAnalysis LoudnessAnalyser::analyse(const juce::AudioBuffer<float>& audio, double sampleRate)
+{
+    const int numChannels = audio.getNumChannels();
+
+    return analyseChunks(audio.getNumSamples(), sampleRate, [&](juce::int64 start, int numPreRoll, int numSamples, int subBlockSize)
+    {
+        std::vector<const float*> channels((size_t)numChannels);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            channels[(size_t)ch] = audio.getReadPointer(ch, (int)start - numPreRoll);
+
+        return analyseRange(channels.data(), numChannels, numPreRoll, numSamples, sampleRate, subBlockSize);
+    });
+}
+
+LoudnessAnalysis LoudnessAnalyser::analyseFile(const juce::File& file, juce::AudioFormatManager& formatManager)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader == nullptr)
+        return {};
+
+    const int numChannels = (int)reader->numChannels;
+    const double sampleRate = reader->sampleRate;
+
+    //Um reader por thread, para as leituras também correrem em paralelo. São criados aqui, em série:
+    //o createReaderFor não pode ser chamado ao mesmo tempo a partir de várias threads
+    juce::OwnedArray<juce::AudioFormatReader> readers;
+    readers.add(reader.release());
+
+    for (int i = 0; i < pool.getNumWorkers(); ++i)
+    {
+        auto* extraReader = formatManager.createReaderFor(file);
+
+        if (extraReader == nullptr)
+            return {};
+
+        readers.add(extraReader);
+    }
+
+    //Readers livres; nunca há mais pedaços a correr ao mesmo tempo do que readers
+    std::vector<juce::AudioFormatReader*> freeReaders;
+
+    for (int i = 0; i < readers.size(); ++i)
+        freeReaders.push_back(readers[i]);
+
+    juce::CriticalSection freeReadersLock;
+
+    return analyseChunks(readers[0]->lengthInSamples, sampleRate, [&](juce::int64 start, int numPreRoll, int numSamples, int subBlockSize)
+    {
+        juce::AudioFormatReader* chunkReader;
+
+        {
+            const juce::ScopedLock sl(freeReadersLock);
+            jassert(! freeReaders.empty());
+            chunkReader = freeReaders.back();
+            freeReaders.pop_back();
+        }
+
+        juce::AudioBuffer<float> chunk(numChannels, numPreRoll + numSamples);
+
+        //Só esta versão do read() indica se a leitura falhou (a versão com AudioBuffer devolve void)
+        const bool readOk = chunkReader->read(chunk.getArrayOfWritePointers(), numChannels, start - numPreRoll, numPreRoll + numSamples);
+
+        {
+            const juce::ScopedLock sl(freeReadersLock);
+            freeReaders.push_back(chunkReader);
+        }
+
+        if (! readOk)
+        {
+            ChunkStats failed;
+            failed.failed = true;
+            return failed;
+        }
+
+        return analyseRange(chunk.getArrayOfReadPointers(), numChannels, numPreRoll, numSamples, sampleRate, subBlockSize);
+    });
+}
+
+LoudnessAnalysis LoudnessAnalyser::analyseChunks(juce::int64 totalSamples, double sampleRate,
+                                                 const std::function<ChunkStats(juce::int64, int, int, int)>& analyseChunk)
+{
+    if (totalSamples <= 0 || sampleRate <= 0.0)
+        return {};
+
+    const int subBlockSize = juce::roundToInt(sampleRate * 0.1);
+    const int chunkSize = (int)juce::jmin((juce::int64)subBlockSize * subBlocksPerChunk, totalSamples + subBlockSize);
+    const int preRollSize = juce::roundToInt(sampleRate * 0.5);
+    const int numChunks = (int)((totalSamples + chunkSize - 1) / chunkSize);
+
+    std::vector<ChunkStats> chunks((size_t)numChunks);
+
+    pool.run(numChunks, [&](int index)
+    {
+        const juce::int64 start = (juce::int64)index * chunkSize;
+        const int numPreRoll = (int)juce::jmin((juce::int64)preRollSize, start);
+        const int numSamples = (int)juce::jmin((juce::int64)chunkSize, totalSamples - start);
+
+        chunks[(size_t)index] = analyseChunk(start, numPreRoll, numSamples, subBlockSize);
+    });
+
+    return computeResult(chunks);
+}
+
+LoudnessAnalyser::ChunkStats LoudnessAnalyser::analyseRange(const float* const* channels, int numChannels, int numPreRoll, int numSamples,
+                                                            double sampleRate, int subBlockSize)
+{
+    ChunkStats stats;
+    const int numSubBlocks = numSamples / subBlockSize; //Só contam sub-blocos completos
+    stats.subBlockEnergies.assign((size_t)numSubBlocks, 0.0);
+
+    const int oversampling = getOversampling(sampleRate);
+    const std::vector<float> taps = makeInterpolationFilter(oversampling);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const float* samples = channels[ch];
+        const double weight = getChannelWeight(ch, numChannels);
+
+        Biquad shelf, highPass;
+        makeKWeighting(sampleRate, shelf, highPass);
+
+        //Pre-roll: só serve para os filtros estabilizarem
+        for (int n = 0; n < numPreRoll; ++n)
+            highPass.process(shelf.process(samples[n]));
+
+        for (int block = 0; block < numSubBlocks; ++block)
+        {
+            double sum = 0.0;
+
+            for (int n = 0; n < subBlockSize; ++n)
+            {
+                const double y = highPass.process(shelf.process(samples[numPreRoll + block * subBlockSize + n]));
+                sum += y * y;
+            }
+
+            stats.subBlockEnergies[(size_t)block] += weight * sum / (double)subBlockSize;
+        }
+
+        //True peak: interpolação polifásica com o pre-roll (ou zeros no início do ficheiro) como histórico
+        float peak = 0.0f;
+
+        for (int n = numPreRoll; n < numPreRoll + numSamples; ++n)
+        {
+            peak = juce::jmax(peak, std::abs(samples[n]));
+
+            if (oversampling == 1)
+                continue;
+
+            for (int phase = 0; phase < oversampling; ++phase)
+            {
+                float y = 0.0f;
+
+                for (int j = 0; j < truePeakTapsPerPhase && n - j >= 0; ++j)
+                    y += samples[n - j] * taps[(size_t)(j * oversampling + phase)];
+
+                peak = juce::jmax(peak, std::abs(y));
+            }
+        }
+
+        stats.peak = juce::jmax(stats.peak, peak);
+    }
+
+    return stats;
+}
+
+LoudnessAnalysis LoudnessAnalyser::computeResult(const std::vector<ChunkStats>& chunks)
+{
+    LoudnessAnalysis result;
+
+    //Juntar as estatísticas dos pedaços pela ordem do ficheiro
+    std::vector<double> subBlocks;
+    float peak = 0.0f;
+
+    for (auto& chunk : chunks)
+    {
+        //Um pedaço em falta juntaria nas janelas áudio de um lado e do outro do buraco
+        if (chunk.failed)
+            return {};
+
+        subBlocks.insert(subBlocks.end(), chunk.subBlockEnergies.begin(), chunk.subBlockEnergies.end());
+        peak = juce::jmax(peak, chunk.peak);
+    }
+
+    result.truePeakDb = juce::Decibels::gainToDecibels((double)peak, -std::numeric_limits<double>::infinity());
+
+    //Blocos de 400 ms (momentary) e de 3 s (short-term), ambos com passo de 100 ms
+    auto windowEnergies = [&subBlocks](int length)
+    {
+        std::vector<double> energies;
+
+        for (size_t i = 0; i + (size_t)length <= subBlocks.size(); ++i)
+        {
+            double sum = 0.0;
+
+            for (int j = 0; j < length; ++j)
+                sum += subBlocks[i + (size_t)j];
+
+            energies.push_back(sum / (double)length);
+        }
+
+        return energies;
+    };
+
+    result.momentaryEnergies = windowEnergies(4);
+    result.integratedLufs = gatedLoudness(result.momentaryEnergies, -10.0);
+
+    //Loudness range (EBU Tech 3342): gate absoluto de -70 LUFS e relativo de -20 LU, percentis 10 e 95
+    const std::vector<double> shortTerm = windowEnergies(30);
+    const double rangeGate = absoluteGatedLoudness(shortTerm) - 20.0;
+
+    std::vector<double> gated;
+
+    for (double energy : shortTerm)
+    {
+        const double lufs = energyToLufs(energy);
+
+        if (lufs > -70.0 && lufs > rangeGate)
+            gated.push_back(lufs);
+    }
+
+    if (! gated.empty())
+    {
+        std::sort(gated.begin(), gated.end());
+        result.shortTermLow = percentile(gated, 0.10);
+        result.shortTermHigh = percentile(gated, 0.95);
+        result.loudnessRange = result.shortTermHigh - result.shortTermLow;
+    }
+    else if (result.isValid())
+    {
+        //Ficheiros mais curtos do que 3 s: não há short-term, usa-se o integrated
+        result.shortTermLow = result.shortTermHigh = result.integratedLufs;
+    }
+
+    return result;
+}
+
+double LoudnessAnalyser::absoluteGatedLoudness(const std::vector<double>& energies)
+{
+    double sum = 0.0;
+    int count = 0;
+
+    for (double energy : energies)
+    {
+        if (energy > 0.0 && energyToLufs(energy) > -70.0)
+        {
+            sum += energy;
+            ++count;
+        }
+    }
+
+    return count > 0 ? energyToLufs(sum / count) : -std::numeric_limits<double>::infinity();
+}
+
+double LoudnessAnalyser::gatedLoudness(const std::vector<double>& energies, double relativeGate)
+{
+    const double threshold = juce::jmax(-70.0, absoluteGatedLoudness(energies) + relativeGate);
+    double sum = 0.0;
+    int count = 0;
+
+    for (double energy : energies)
+    {
+        if (energy > 0.0 && energyToLufs(energy) > threshold)
+        {
+            sum += energy;
+            ++count;
+        }
+    }
+
+    return count > 0 ? energyToLufs(sum / count) : -std::numeric_limits<double>::infinity();
+}
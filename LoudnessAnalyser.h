@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    LoudnessAnalyser.h
+    Created: 19 Oct 2026 3:21:47pm
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <vector>
+#include "ChannelWorkerPool.h"
+
+//Resultado da análise de loudness de um ficheiro (ITU-R BS.1770 / EBU R128)
+struct LoudnessAnalysis
+{
+    double integratedLufs = -std::numeric_limits<double>::infinity();
+    double loudnessRange = 0.0;   //LU
+    double shortTermLow = 0.0;    //Percentil 10 do short-term loudness (LUFS), limite inferior do LRA
+    double shortTermHigh = 0.0;   //Percentil 95 do short-term loudness (LUFS), limite superior do LRA
+    double truePeakDb = -std::numeric_limits<double>::infinity();
+
+    std::vector<double> momentaryEnergies; //Energia K-weighted de cada bloco de 400 ms (passo de 100 ms)
+
+    bool isValid() const { return std::isfinite(integratedLufs); }
+};
+
+//==============================================================================
+/**
+    Análise de loudness para trabalhos offline: integrated loudness, loudness
+    range e true peak.
+
+    O ficheiro é dividido em pedaços alinhados a sub-blocos de 100 ms que são
+    analisados em paralelo; cada pedaço devolve a energia dos seus sub-blocos
+    e o seu true peak, e o gating (que precisa do ficheiro inteiro) é feito
+    depois de juntar os pedaços por ordem. Cada pedaço começa com um pre-roll
+    de 0.5 s para os filtros K-weighting estabilizarem, por isso o resultado
+    só difere de uma análise em série por muito menos de 0.01 LU.
+
+    No analyseFile os readers são todos criados antes de a análise começar, na
+    thread que chama (o AudioFormatManager não é thread safe), e cada pedaço
+    usa um reader que nenhum outro pedaço está a usar nesse momento.
+*/
+class LoudnessAnalyser
+{
+public:
+    //subBlocksPerChunk: tamanho de cada pedaço em sub-blocos de 100 ms (100 = 10 s)
+    explicit LoudnessAnalyser(int subBlocksPerChunk = 100);
+
+    LoudnessAnalysis analyse(const juce::AudioBuffer<float>& audio, double sampleRate);
+    LoudnessAnalysis analyseFile(const juce::File& file, juce::AudioFormatManager& formatManager);
+
+    //Loudness (LUFS) de um conjunto de blocos com gate absoluto de -70 LUFS e gate relativo relativeGate LU abaixo
+    static double gatedLoudness(const std::vector<double>& energies, double relativeGate);
+
+    //Loudness (LUFS) dos blocos acima do gate absoluto de -70 LUFS
+    static double absoluteGatedLoudness(const std::vector<double>& energies);
+
+    static double energyToLufs(double energy) { return -0.691 + 10.0 * std::log10(energy); }
+
+private:
+    struct ChunkStats
+    {
+        std::vector<double> subBlockEnergies;
+        float peak = 0.0f;
+        bool failed = false; //Pedaço que não foi possível ler: a análise inteira fica inválida
+    };
+
+    //channels apontam para o início do pre-roll; só as samples depois do pre-roll contam
+    static ChunkStats analyseRange(const float* const* channels, int numChannels, int numPreRoll, int numSamples,
+                                   double sampleRate, int subBlockSize);
+
+    LoudnessAnalysis analyseChunks(juce::int64 totalSamples, double sampleRate,
+                                   const std::function<ChunkStats(juce::int64 start, int numPreRoll, int numSamples, int subBlockSize)>& analyseChunk);
+
+    static LoudnessAnalysis computeResult(const std::vector<ChunkStats>& chunks);
+
+    const int subBlocksPerChunk;
+
+    ChannelWorkerPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessAnalyser)
+};
@@ -8,6 +8,8 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "BlockCapture.h"
+#include "LoudnessAnalyser.h"
 
 
 
@@ -24,10 +26,12 @@ KeblexCompAudioProcessor::KeblexCompAudioProcessor()
                        )
 #endif
 {
+    blockCapture = std::make_unique<BlockCapture>();
 }
 
 KeblexCompAudioProcessor::~KeblexCompAudioProcessor()
 {
+    stopCapture();
 }
 
 //==============================================================================
@@ -97,14 +101,42 @@ void KeblexCompAudioProcessor::prepareToPlay (double sampleRate, int samplesPerB
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    timeElapsed = 0.0;
-    curCompState = OFF;
+    const int numChannels = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+
+    channelStates.assign(numChannels, ChannelCompState());
+    channelLevels.assign(numChannels, 0.0f);
+
+    detectorEnvelopeCoeff = (float)std::exp(-1.0 / (detectorTimeConstant * sampleRate));
+    maxChunkSamples = juce::jmax(1, samplesPerBlock);
+    channelEnvelopes.assign((size_t)numChannels * (size_t)maxChunkSamples, 0.0f);
+    channelDitherSeeds.resize(numChannels);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        channelDitherSeeds[ch] = 0x9e3779b9u * (juce::uint32)(ch + 1);
+
+    //As threads só existem em renders offline (o host chama setNonRealtime antes do prepareToPlay);
+    //em tempo real o caminho é sempre em série e não vale a pena ter threads paradas por instância
+    if (isNonRealtime())
+    {
+        if (workerPool == nullptr)
+        {
+            const int numWorkers = juce::jlimit(0, 7, juce::SystemStats::getNumCpus() - 1);
+
+            if (numWorkers > 0)
+                workerPool = std::make_unique<ChannelWorkerPool>(numWorkers);
+        }
+    }
+    else
+    {
+        workerPool.reset();
+    }
 }
 
 void KeblexCompAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    workerPool.reset();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -133,6 +165,69 @@ bool KeblexCompAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
 }
 #endif
 
+namespace
+{
+    //Acesso às samples de um canal dentro dos kernels do compressor. A conversão de formato
+    //e o input gain são feitos na leitura, e o dither e a quantização na escrita, para não
+    //serem precisas passagens extra pela memória.
+    struct FloatChannel
+    {
+        float* data;
+        int stride;
+        float inGain;
+
+        float read(int n) const { return data[n * stride] * inGain; }
+        void write(int n, float value) { data[n * stride] = value; }
+    };
+
+    //Dither TPDF de +-1 LSB, com um gerador por canal para poder correr em paralelo
+    inline float nextDither(juce::uint32& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const float r1 = (float)(seed >> 8) * (1.0f / 16777216.0f);
+        seed = seed * 1664525u + 1013904223u;
+        const float r2 = (float)(seed >> 8) * (1.0f / 16777216.0f);
+        return r1 - r2;
+    }
+
+    template <int numBits>
+    inline int quantise(float value, juce::uint32* ditherSeed)
+    {
+        const double fullScale = (double)(1LL << (numBits - 1));
+        double scaled = (double)value * fullScale;
+
+        if (ditherSeed != nullptr)
+            scaled += nextDither(*ditherSeed);
+
+        return (int)juce::jlimit(-fullScale, fullScale - 1.0, std::round(scaled));
+    }
+
+    template <typename IntType, int numBits>
+    struct IntChannel
+    {
+        IntType* data;
+        int stride;
+        float inGain;
+        juce::uint32* ditherSeed; //nullptr = sem dither
+
+        //Os dados vêm em little endian; em máquinas big endian é preciso trocar os bytes
+        float read(int n) const { return (float)juce::ByteOrder::swapIfBigEndian(data[n * stride]) * (inGain / (float)(1LL << (numBits - 1))); }
+        void write(int n, float value) { data[n * stride] = juce::ByteOrder::swapIfBigEndian((IntType)quantise<numBits>(value, ditherSeed)); }
+    };
+
+    //24 bits empacotados em 3 bytes (little endian)
+    struct Int24Channel
+    {
+        char* data;
+        int stride; //em bytes
+        float inGain;
+        juce::uint32* ditherSeed;
+
+        float read(int n) const { return (float)juce::ByteOrder::littleEndian24Bit(data + n * stride) * (inGain / 8388608.0f); }
+        void write(int n, float value) { juce::ByteOrder::littleEndian24BitToChars(quantise<24>(value, ditherSeed), data + n * stride); }
+    };
+}
+
 void KeblexCompAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     static int counter = 0; //to track number of samples overtime
@@ -140,6 +235,14 @@ void KeblexCompAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
     const int totalNumInputChannels = getTotalNumInputChannels();
     const int totalNumOutputChannels = getTotalNumOutputChannels();
 
+    //Os parâmetros podem mudar a partir da GUI, por isso lêem-se uma vez por bloco
+    const CompressorParams params = getCurrentParams();
+
+    if (blockCapture->isCapturing())
+    {
+        blockCapture->pushBlock(buffer, params, channelStates.data(), (int)channelStates.size(), isNonRealtime());
+    }
+
     for (int i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
     {
         buffer.clear(i, 0, buffer.getNumSamples());
@@ -147,58 +250,248 @@ void KeblexCompAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
 
     // This is the place where you'd normally do the guts of your plugin's
     // audio processing...
-   
-    //Aplica input gain ao buffer inteiro de uma só vez
-    float linInGain = powf(10, curInGain / 20.0);
-    buffer.applyGain(linInGain);
+    const int numChannels = juce::jmin(totalNumInputChannels, (int)channelStates.size());
+    const KernelGains gains = getKernelGains(params);
+
+    //Os ponteiros são pedidos aqui, na thread que chama: getWritePointer altera o estado do buffer
+    //e não pode ser chamado a partir das threads do pool
+    float* const* channelData = buffer.getArrayOfWritePointers();
+
+    //O input gain é aplicado na leitura de cada sample, dentro dos kernels
+    processChunks(buffer.getNumSamples(), numChannels, maxChunkSamples, true, params, gains, [&](int ch, int startSample)
+    {
+        return FloatChannel { channelData[ch] + startSample, 1, gains.linInGain };
+    });
+}
+
+void KeblexCompAudioProcessor::processInterleaved(void* data, PcmFormat format, int numChannels, int numFrames, bool dither)
+{
+    //Sem prepareToPlay não há estado dos canais e nada seria processado
+    jassert(! channelStates.empty() && numChannels <= (int)channelStates.size());
+
+    const CompressorParams params = getCurrentParams();
+    const KernelGains gains = getKernelGains(params);
+    const int numProcessed = juce::jmin(numChannels, (int)channelStates.size());
+
+    auto seedFor = [&](int ch) { return dither ? &channelDitherSeeds[ch] : nullptr; };
 
-    float chMagnitude; //Calcula a magnitude para todos os canais (seja através de PEAK ou RMS)
+    //Os canais intercalados partilham linhas de cache: em paralelo as threads escreveriam nas mesmas linhas
+    const int chunkFrames = juce::jmin(interleavedChunkFrames, maxChunkSamples);
 
-    //percorre cada canal para o  current frame
-    for (int ch = 0; ch < totalNumInputChannels; ++ch)
+    switch (format)
     {
-        //Para a deteção PEAK
-        if (detMode == PEAK)
+    case(PCM_INT16):
+        processChunks(numFrames, numProcessed, chunkFrames, false, params, gains, [&](int ch, int startFrame)
         {
-            chMagnitude = buffer.getMagnitude(ch, 0, buffer.getNumSamples());
-        }
-        else if (detMode == RMS)
+            return IntChannel<juce::int16, 16> { static_cast<juce::int16*>(data) + startFrame * numChannels + ch,
+                                                 numChannels, gains.linInGain, seedFor(ch) };
+        });
+        break;
+
+    case(PCM_INT24):
+        processChunks(numFrames, numProcessed, chunkFrames, false, params, gains, [&](int ch, int startFrame)
         {
-            chMagnitude = buffer.getRMSLevel(ch, 0, buffer.getNumSamples());
-        }
+            return Int24Channel { static_cast<char*>(data) + (startFrame * numChannels + ch) * 3,
+                                  numChannels * 3, gains.linInGain, seedFor(ch) };
+        });
+        break;
 
-        //Percorre cada frame para esta callback
-        for (int n = 0; n < buffer.getNumSamples(); ++n)
+    case(PCM_INT32):
+        processChunks(numFrames, numProcessed, chunkFrames, false, params, gains, [&](int ch, int startFrame)
         {
-            //Obter o sinal e o valor absoluto da sample atual
-            float curSample = buffer.getSample(ch, n);
-            float sign = (curSample > 0) - (curSample < 0);
-            float curSampleAbs = fabsf(curSample);
+            return IntChannel<juce::int32, 32> { static_cast<juce::int32*>(data) + startFrame * numChannels + ch,
+                                                 numChannels, gains.linInGain, seedFor(ch) };
+        });
+        break;
 
-            //Converter valores em dB para linear amplitude
-            float linThreshold = powf(10, curThresh / 20.0);
-            float linOutGain = powf(10, curOutGain / 20.0);
+    case(PCM_FLOAT32):
+        processChunks(numFrames, numProcessed, chunkFrames, false, params, gains, [&](int ch, int startFrame)
+        {
+            return FloatChannel { static_cast<float*>(data) + startFrame * numChannels + ch, numChannels, gains.linInGain };
+        });
+        break;
 
-            //Cada amostra tem o que chamarei de 'base' (a parte da sample até o valor do threshold) e um remaind (a parte da sample, se houver, que excede o limite)
-            float base = (curSampleAbs > linThreshold) ? linThreshold : curSampleAbs;
-            float remainder = (curSampleAbs > linThreshold) ? (curSampleAbs - linThreshold) : 0.0;
+    default:
+        break;
+    }
+}
 
-            //Ajustar o ratio - converter de dB para magnitude
-            float linRatio = 1.0 / powf(10, ((float)curRatio) / 20.0);
+KeblexCompAudioProcessor::KernelGains KeblexCompAudioProcessor::getKernelGains(const CompressorParams& params)
+{
+    KernelGains gains;
 
-            // Calcular a nova sample, comprimida ou não
-            float compressedSampleVal = (base + (remainder * linRatio)) * sign;
-            float interpVal = getInterpCompVal(chMagnitude, curSample, compressedSampleVal, linThreshold);
+    //Converter valores em dB para linear amplitude (uma vez por bloco)
+    gains.linInGain = powf(10, params.inGain / 20.0);
+    gains.linThreshold = powf(10, params.thresh / 20.0);
+    gains.linOutGain = powf(10, params.outGain / 20.0);
 
-            buffer.setSample(ch, n, interpVal * linOutGain);
-        }
+    //Ajustar o ratio - converter de dB para magnitude
+    gains.linRatio = 1.0 / powf(10, ((float)params.ratio) / 20.0);
+
+    return gains;
+}
+
+template <typename ChannelMaker>
+void KeblexCompAudioProcessor::processChunks(int numSamples, int numChannels, int chunkSize, bool allowParallel,
+                                             const CompressorParams& params, const KernelGains& gains, ChannelMaker&& makeChannel)
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        channelLevels[ch] = 0.0f;
+    }
+
+    //Blocos maiores do que o anunciado no prepareToPlay são processados em pedaços (o resultado é o mesmo)
+    chunkSize = juce::jlimit(1, maxChunkSamples, chunkSize);
+
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        processChunk(start, juce::jmin(chunkSize, numSamples - start), numChannels, allowParallel, params, gains, makeChannel);
+    }
+
+    if (numChannels > 0)
+        curSampleVal = channelLevels[numChannels - 1]; //O valor de potência exibido na interface gráfica (GUI)
+}
+
+template <typename ChannelMaker>
+void KeblexCompAudioProcessor::processChunk(int startSample, int numSamples, int numChannels, bool allowParallel,
+                                            const CompressorParams& params, const KernelGains& gains, ChannelMaker& makeChannel)
+{
+    //1º passo: detetor de cada canal (a envolvente só depende das samples, não do tamanho do bloco)
+    auto detectOneChannel = [&](int ch)
+    {
+        detectChannel(makeChannel(ch, startSample), numSamples, params.detMode, detectorEnvelopeCoeff,
+                      channelStates[ch], channelEnvelopes.data() + (size_t)ch * (size_t)maxChunkSamples);
+    };
+
+    //2º passo: ganho de cada canal, já com a envolvente do detetor conhecida
+    auto processOneChannel = [&](int ch)
+    {
+        auto samples = makeChannel(ch, startSample);
+        const float level = processChannel(samples, numSamples, channelEnvelopes.data() + (size_t)ch * (size_t)maxChunkSamples,
+                                           channelStates[ch], params, gains);
 
         //Calcular o RMS e exibi-lo
-        float curMag = buffer.getMagnitude(ch, 0, buffer.getNumSamples());
-        curSampleVal = curMag; //O valor de potência exibido na interface gráfica (GUI)
+        channelLevels[ch] = juce::jmax(channelLevels[ch], level);
+    };
+
+    const bool parallel = allowParallel && shouldProcessInParallel(numChannels, numSamples);
+
+    if (parallel)
+    {
+        workerPool->run(numChannels, detectOneChannel);
+    }
+    else
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            detectOneChannel(ch);
+    }
+
+    //Canais ligados partilham o detetor: em cada sample todos usam a maior magnitude do grupo
+    const int groupSize = juce::jmax(1, params.linkGroupSize);
+
+    if (groupSize > 1)
+    {
+        for (int first = 0; first < numChannels; first += groupSize)
+        {
+            const int last = juce::jmin(first + groupSize, numChannels);
+            float* groupEnvelope = channelEnvelopes.data() + (size_t)first * (size_t)maxChunkSamples;
+
+            for (int ch = first + 1; ch < last; ++ch)
+            {
+                const float* envelope = channelEnvelopes.data() + (size_t)ch * (size_t)maxChunkSamples;
+
+                for (int n = 0; n < numSamples; ++n)
+                    groupEnvelope[n] = juce::jmax(groupEnvelope[n], envelope[n]);
+            }
+
+            for (int ch = first + 1; ch < last; ++ch)
+                memcpy(channelEnvelopes.data() + (size_t)ch * (size_t)maxChunkSamples, groupEnvelope, (size_t)numSamples * sizeof(float));
+        }
+    }
+
+    //Depois do detetor os canais são independentes, por isso podem correr em paralelo
+    if (parallel)
+    {
+        workerPool->run(numChannels, processOneChannel);
+    }
+    else
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            processOneChannel(ch);
     }
 }
 
+template <typename Samples>
+void KeblexCompAudioProcessor::detectChannel(const Samples& samples, int numSamples, DetectionMode mode, float envelopeCoeff,
+                                             ChannelCompState& state, float* envelope)
+{
+    float env = state.detEnvelope;
+
+    if (mode == PEAK)
+    {
+        //Sobe logo com o peak e desce exponencialmente
+        for (int n = 0; n < numSamples; ++n)
+        {
+            env = juce::jmax(fabsf(samples.read(n)), env * envelopeCoeff);
+            envelope[n] = env;
+        }
+    }
+    else if (mode == RMS)
+    {
+        //Média exponencial dos quadrados (o estado guarda a média, a envolvente a raiz)
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const float sample = samples.read(n);
+            env = sample * sample + envelopeCoeff * (env - sample * sample);
+            envelope[n] = sqrtf(env);
+        }
+    }
+
+    state.detEnvelope = env;
+}
+
+template <typename Samples>
+float KeblexCompAudioProcessor::processChannel(Samples& samples, int numSamples, const float* envelope, ChannelCompState& state,
+                                               const CompressorParams& params, const KernelGains& gains)
+{
+    const float linThreshold = gains.linThreshold;
+    const float linRatio = gains.linRatio;
+    const float linOutGain = gains.linOutGain;
+    float level = 0.0f;
+
+    //Percorre cada frame para esta callback
+    for (int n = 0; n < numSamples; ++n)
+    {
+        //Obter o sinal e o valor absoluto da sample atual
+        float curSample = samples.read(n);
+        float sign = (curSample > 0) - (curSample < 0);
+        float curSampleAbs = fabsf(curSample);
+
+        //Cada amostra tem o que chamarei de 'base' (a parte da sample até o valor do threshold) e um remaind (a parte da sample, se houver, que excede o limite)
+        float base = (curSampleAbs > linThreshold) ? linThreshold : curSampleAbs;
+        float remainder = (curSampleAbs > linThreshold) ? (curSampleAbs - linThreshold) : 0.0;
+
+        // Calcular a nova sample, comprimida ou não
+        float compressedSampleVal = (base + (remainder * linRatio)) * sign;
+        float interpVal = getInterpCompVal(state, params, envelope[n], curSample, compressedSampleVal, linThreshold);
+
+        const float outSample = interpVal * linOutGain;
+        samples.write(n, outSample);
+        level = juce::jmax(level, fabsf(outSample));
+    }
+
+    return level;
+}
+
+bool KeblexCompAudioProcessor::shouldProcessInParallel(int numChannels, int numSamples) const
+{
+    //Em tempo real fica sempre o caminho em série: acordar threads no audio thread não compensa
+    return workerPool != nullptr
+        && isNonRealtime()
+        && numChannels >= parallelMinChannels
+        && numSamples >= parallelMinSamples;
+}
+
 //==============================================================================
 bool KeblexCompAudioProcessor::hasEditor() const
 {
@@ -231,20 +524,20 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new KeblexCompAudioProcessor();
 }
 
-float KeblexCompAudioProcessor::getInterpCompVal(float valToCheck, float unCompressedVal, float compressedVal, float linearThreshold)
+float KeblexCompAudioProcessor::getInterpCompVal(ChannelCompState& state, const CompressorParams& params, float valToCheck, float unCompressedVal, float compressedVal, float linearThreshold)
 {
-    switch (curCompState)
+    switch (state.compState)
     {
     case(ATTACK):
-        if (timeElapsed < curAtkTime) 
+        if (state.timeElapsed < params.atkTime) 
         {
             //Atualizar quanto tempo passou no estado atual
-            timeElapsed += 1 / getSampleRate();
+            state.timeElapsed += 1 / getSampleRate();
             //Retornar o valor interpolado linearmente comprimido se o não comprimido estiver acima do threshold
             if (unCompressedVal > linearThreshold)
             {
-                return ((timeElapsed * compressedVal) +
-                    ((curAtkTime - timeElapsed) * unCompressedVal)) * 0.5 / curAtkTime;
+                return ((state.timeElapsed * compressedVal) +
+                    ((params.atkTime - state.timeElapsed) * unCompressedVal)) * 0.5 / params.atkTime;
             }
             else
             {
@@ -254,7 +547,7 @@ float KeblexCompAudioProcessor::getInterpCompVal(float valToCheck, float unCompr
         }
         else //Caso contrário, mudar para o próximo estado
         {
-            changeCompressorState(curCompState, ACTIVE);
+            changeCompressorState(state, ACTIVE);
             return compressedVal;
         }
         break;
@@ -262,7 +555,7 @@ float KeblexCompAudioProcessor::getInterpCompVal(float valToCheck, float unCompr
     case(ACTIVE):
         if (valToCheck <= linearThreshold) //Mudar o estado para 'release' se o peak geral tiver caído abaixo do valor do threshold
         {
-            changeCompressorState(curCompState, RELEASE);
+            changeCompressorState(state, RELEASE);
         }
 
         if (unCompressedVal > linearThreshold) //Ainda assim, apenas comprimimos os valores individuais que estão acima do threshold
@@ -277,16 +570,16 @@ float KeblexCompAudioProcessor::getInterpCompVal(float valToCheck, float unCompr
         break;
 
     case(RELEASE):
-        if (timeElapsed < curRelTime) //Se ainda deveríamos estar no estado 'release'
+        if (state.timeElapsed < params.relTime) //Se ainda deveríamos estar no estado 'release'
         {
-            timeElapsed += 1 / getSampleRate();
+            state.timeElapsed += 1 / getSampleRate();
             //Retornar o valor interpolado linearmente
 
             if (unCompressedVal > linearThreshold)
             {
-                return (((curRelTime - timeElapsed) * compressedVal) +
-                    (timeElapsed * unCompressedVal)) *
-                    0.5 / curRelTime;
+                return (((params.relTime - state.timeElapsed) * compressedVal) +
+                    (state.timeElapsed * unCompressedVal)) *
+                    0.5 / params.relTime;
             }
             else
             {
@@ -296,7 +589,7 @@ float KeblexCompAudioProcessor::getInterpCompVal(float valToCheck, float unCompr
         } //Caso contrário, mudar para o próximo estado
         else
         {
-            changeCompressorState(curCompState, OFF);
+            changeCompressorState(state, OFF);
             return unCompressedVal;
         }
         break;
@@ -304,7 +597,7 @@ float KeblexCompAudioProcessor::getInterpCompVal(float valToCheck, float unCompr
     case(OFF):
         if (valToCheck > linearThreshold)
         {
-            changeCompressorState(curCompState, ACTIVE);
+            changeCompressorState(state, ACTIVE);
         }
 
         return unCompressedVal;
@@ -316,8 +609,108 @@ float KeblexCompAudioProcessor::getInterpCompVal(float valToCheck, float unCompr
         break;
     }
 }
-void KeblexCompAudioProcessor::changeCompressorState(CompressorState prevCompState, CompressorState newCompState)
+void KeblexCompAudioProcessor::changeCompressorState(ChannelCompState& state, CompressorState newCompState)
 {
-    this->curCompState = newCompState;
-    this->timeElapsed = 0.0;
+    state.compState = newCompState;
+    state.timeElapsed = 0.0;
+}
+
+CompressorParams KeblexCompAudioProcessor::getCurrentParams() const
+{
+    CompressorParams params;
+    params.thresh = curThresh;
+    params.inGain = curInGain;
+    params.outGain = curOutGain;
+    params.ratio = curRatio;
+    params.atkTime = curAtkTime;
+    params.relTime = curRelTime;
+    params.detMode = detMode;
+    params.linkGroupSize = linkGroupSize;
+    return params;
+}
+
+void KeblexCompAudioProcessor::setCurrentParams(const CompressorParams& params)
+{
+    curThresh = params.thresh;
+    curInGain = params.inGain;
+    curOutGain = params.outGain;
+    curRatio = params.ratio;
+    curAtkTime = params.atkTime;
+    curRelTime = params.relTime;
+    detMode = params.detMode;
+    linkGroupSize = params.linkGroupSize;
+}
+
+void KeblexCompAudioProcessor::setChannelState(int ch, const ChannelCompState& state)
+{
+    if (ch >= 0 && ch < (int)channelStates.size())
+    {
+        channelStates[ch] = state;
+    }
+}
+
+bool KeblexCompAudioProcessor::startCapture(const juce::File& file, juce::int64 ringSizeBytes)
+{
+    const int numChannels = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    return blockCapture->start(file, ringSizeBytes, getSampleRate(), numChannels, getBlockSize());
+}
+
+void KeblexCompAudioProcessor::stopCapture()
+{
+    blockCapture->stop();
+}
+
+bool KeblexCompAudioProcessor::isCapturing() const
+{
+    return blockCapture->isCapturing();
+}
+
+bool KeblexCompAudioProcessor::applyLoudnessTarget(const LoudnessAnalysis& analysis, const juce::AudioBuffer<float>& audio,
+                                                   double sampleRate, float targetLufs)
+{
+    if (! analysis.isValid() || audio.getNumChannels() == 0 || audio.getNumSamples() == 0 || sampleRate <= 0.0)
+    {
+        return false;
+    }
+
+    CompressorParams params = getCurrentParams();
+
+    //Para um sinal estável LUFS ~ RMS em dBFS; em modo PEAK o detetor vê mais ~3 dB (crest de uma sinusoide)
+    const float crestDb = (params.detMode == PEAK) ? 3.0f : 0.0f;
+    const float rmsThreshDb = juce::jlimit(-60.0f, 0.0f, (float)analysis.shortTermHigh + params.inGain);
+
+    curThresh = juce::jlimit(-60.0f, 0.0f, rmsThreshDb + crestDb);
+
+    //Passar o áudio uma vez pelo compressor com o novo threshold e sem output gain, e medir o resultado.
+    //O output gain é aplicado depois da compressão, por isso o makeup gain sai diretamente da diferença.
+    params.thresh = curThresh;
+    params.outGain = 0.0f;
+
+    const int numChannels = audio.getNumChannels();
+    const int renderBlockSize = 4096;
+
+    KeblexCompAudioProcessor renderer;
+    renderer.setPlayConfigDetails(numChannels, numChannels, sampleRate, renderBlockSize);
+    renderer.setNonRealtime(true);
+    renderer.prepareToPlay(sampleRate, renderBlockSize);
+    renderer.setCurrentParams(params);
+
+    juce::AudioBuffer<float> rendered(audio);
+    juce::MidiBuffer midi;
+    renderer.processBlock(rendered, midi);
+    renderer.releaseResources();
+
+    LoudnessAnalyser analyser;
+    const double renderedLufs = analyser.analyse(rendered, sampleRate).integratedLufs;
+
+    if (! std::isfinite(renderedLufs))
+    {
+        return false;
+    }
+
+    //Mesmos limites do slider de output gain
+    const float requiredGain = (float)(targetLufs - renderedLufs);
+    curOutGain = juce::jlimit(-20.0f, 12.0f, requiredGain);
+
+    return curOutGain == requiredGain;
 }
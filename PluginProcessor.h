@@ -9,6 +9,8 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <vector>
+#include "ChannelWorkerPool.h"
 
 enum DetectionMode
 {
@@ -24,6 +26,40 @@ enum CompressorState
     OFF
 };
 
+//Estado do compressor de cada canal (cada canal tem o seu para poderem ser processados em paralelo)
+struct ChannelCompState
+{
+    CompressorState compState = OFF;
+    float timeElapsed = 0.0f; //for attack and release times
+
+    //Envolvente do detetor, atualizada a cada sample e continuada de um bloco para o outro, por isso o resultado
+    //não depende do tamanho dos blocos do host. Em PEAK é a amplitude, em RMS a média dos quadrados.
+    float detEnvelope = 0.0f;
+};
+
+//Cópia dos parâmetros lida uma vez no início de cada bloco (também é o que fica gravado na captura)
+struct CompressorParams
+{
+    float thresh = 0.0f, inGain = 0.0f, outGain = 0.0f;
+    int ratio = 1;
+    float atkTime = 0.0f, relTime = 0.0f;
+    DetectionMode detMode = PEAK;
+    int linkGroupSize = 1;
+};
+
+//Formatos aceites pelo processInterleaved: inteiros sempre em little endian (24 bits empacotados em 3 bytes),
+//float32 na ordem nativa da máquina
+enum PcmFormat
+{
+    PCM_INT16,
+    PCM_INT24,
+    PCM_INT32,
+    PCM_FLOAT32
+};
+
+class BlockCapture;
+struct LoudnessAnalysis;
+
 //==============================================================================
 /**
 */
@@ -47,6 +83,13 @@ public:
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
+    //Processa frames intercaladas no próprio buffer, sem passar por um juce::AudioBuffer<float>.
+    //A conversão de/para float é feita dentro do kernel; dither TPDF opcional na escrita (só formatos inteiros).
+    //Tal como no processBlock, é obrigatório chamar setPlayConfigDetails e prepareToPlay antes (com pelo menos
+    //numChannels canais e o tamanho de bloco esperado). É sempre processado em série, em pedaços pequenos que cabem
+    //na cache, porque cada canal é lido com um salto de numChannels samples. Estes blocos não são gravados pela captura.
+    void processInterleaved (void* data, PcmFormat format, int numChannels, int numFrames, bool dither = false);
+
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -75,13 +118,82 @@ public:
     float curAtkTime, curRelTime;
     float curSampleVal;
     DetectionMode detMode;
-    float timeElapsed; //for attack and release times
-    CompressorState curCompState;
-
-    float getInterpCompVal(float valToCheck, float unCompressedVal, float compressedVal, float linearThreshold);
-    void changeCompressorState(CompressorState prevCompState, CompressorState newCompState);
+    int linkGroupSize = 1; //Nº de canais consecutivos que partilham o detetor (1 = canais independentes)
+
+    float getInterpCompVal(ChannelCompState& state, const CompressorParams& params, float valToCheck, float unCompressedVal, float compressedVal, float linearThreshold);
+    void changeCompressorState(ChannelCompState& state, CompressorState newCompState);
+
+    CompressorParams getCurrentParams() const;
+    void setCurrentParams(const CompressorParams& params);
+    void setChannelState(int ch, const ChannelCompState& state);
+
+    //Grava os blocos que chegam ao processBlock num ficheiro em anel para depois os reproduzir offline
+    //(chamar depois do prepareToPlay, para o tamanho máximo de bloco ser conhecido)
+    bool startCapture(const juce::File& file, juce::int64 ringSizeBytes);
+    void stopCapture();
+    bool isCapturing() const;
+
+    //Ajusta curThresh e curOutGain (antes de um render offline) para a saída ficar em targetLufs.
+    //analysis tem de ser a análise de audio. O threshold fica no percentil 95 do short-term loudness (topo
+    //do loudness range), por isso só os momentos mais fortes são comprimidos e na prática isto funciona
+    //sobretudo como normalização de ganho. O makeup gain é medido: o áudio passa uma vez por um processador
+    //temporário com os parâmetros atuais e o novo threshold (custa mais ou menos um render offline).
+    //Devolve false se a análise for inválida ou se o ganho necessário sair dos limites do output gain
+    //(-20..+12 dB); nesse caso curOutGain fica no limite e o alvo não é atingido.
+    bool applyLoudnessTarget(const LoudnessAnalysis& analysis, const juce::AudioBuffer<float>& audio,
+                             double sampleRate, float targetLufs);
 
 private:
+    struct KernelGains
+    {
+        float linInGain, linThreshold, linRatio, linOutGain;
+    };
+
+    static KernelGains getKernelGains(const CompressorParams& params);
+
+    //makeChannel(ch, startSample) devolve o acesso às samples desse canal (float, inteiro, intercalado...)
+    //O bloco é dividido em pedaços de chunkSize samples (no máximo maxChunkSamples)
+    template <typename ChannelMaker>
+    void processChunks(int numSamples, int numChannels, int chunkSize, bool allowParallel,
+                       const CompressorParams& params, const KernelGains& gains, ChannelMaker&& makeChannel);
+
+    template <typename ChannelMaker>
+    void processChunk(int startSample, int numSamples, int numChannels, bool allowParallel,
+                      const CompressorParams& params, const KernelGains& gains, ChannelMaker& makeChannel);
+
+    //Escreve em envelope a magnitude do detetor em cada sample do bloco
+    template <typename Samples>
+    static void detectChannel(const Samples& samples, int numSamples, DetectionMode mode, float envelopeCoeff,
+                              ChannelCompState& state, float* envelope);
+
+    //Processa as samples de um canal depois de a envolvente do detetor ser conhecida; devolve o peak da saída
+    template <typename Samples>
+    float processChannel(Samples& samples, int numSamples, const float* envelope, ChannelCompState& state,
+                         const CompressorParams& params, const KernelGains& gains);
+
+    bool shouldProcessInParallel(int numChannels, int numSamples) const;
+
+    static constexpr int parallelMinChannels = 4;
+    static constexpr int parallelMinSamples = 2048;
+    //Pedaço do processInterleaved: os dois passos (detetor e ganho) percorrem cada canal com salto, por isso o
+    //pedaço tem de continuar na cache entre eles (256 frames de 8 canais em float32 são 8 KB)
+    static constexpr int interleavedChunkFrames = 256;
+    //Constante de tempo da envolvente: 10 ms cobrem um ciclo completo até 100 Hz, para o RMS não oscilar dentro
+    //de um período e fazer o estado saltar entre ACTIVE e RELEASE. Em PEAK só afeta a descida (a subida é
+    //imediata, nenhum transiente passa sem ser visto). O coeficiente sai da sample rate no prepareToPlay.
+    //Qualquer alteração muda a saída e obriga a regenerar Tests/BlockSizeInvariance/Golden.
+    static constexpr double detectorTimeConstant = 0.010;
+
+    float detectorEnvelopeCoeff = 0.0f;
+    int maxChunkSamples = 1;
+
+    std::vector<ChannelCompState> channelStates;
+    std::vector<float> channelEnvelopes; //maxChunkSamples valores por canal
+    std::vector<juce::uint32> channelDitherSeeds;
+    std::vector<float> channelLevels;
+    std::unique_ptr<ChannelWorkerPool> workerPool;
+    std::unique_ptr<BlockCapture> blockCapture;
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KeblexCompAudioProcessor)
 };
@@ -0,0 +1,274 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 20 Oct 2026 10:02:33am
+
+    Teste de regressão do processBlock: passa sinais de referência pelo
+    processador com várias partições em blocos (fixa de 32 samples,
+    aleatórias, um só bloco, blocos maiores do que o do prepareToPlay, em
+    série e em paralelo) e verifica que as saídas são iguais entre si e
+    iguais aos ficheiros golden dentro de uma tolerância.
+
+    Uso: BlockSizeInvariance [pasta golden] [--update]
+         (por omissão Tests/BlockSizeInvariance/Golden, a partir da raiz do repositório)
+         --update regenera os ficheiros golden; só deve ser usado quando a
+         mudança de som é intencional.
+
+    Compila como uma Console Application do JUCE com os mesmos ficheiros de
+    código e módulos do plugin. Devolve 0 se todos os casos passarem.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../PluginProcessor.h"
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numChannels = 4;
+    constexpr int numSamples = 12000;
+
+    //Entre partições o resultado tem de ser exatamente o mesmo; contra os golden há margem
+    //para diferenças de compilador/plataforma nas funções de vírgula flutuante
+    constexpr float partitionTolerance = 0.0f;
+    constexpr float goldenTolerance = 1.0e-4f;
+
+    //Sinais de referência determinísticos, um por canal, com partes acima e abaixo do threshold
+    juce::AudioBuffer<float> makeReferenceSignal()
+    {
+        juce::AudioBuffer<float> signal (numChannels, numSamples);
+        juce::uint32 seed = 12345;
+        const double twoPi = juce::MathConstants<double>::twoPi;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const double t = n / sampleRate;
+
+            //100 Hz com degraus de nível (frequência baixa, onde um detetor curto oscila)
+            const double steps = ((n / 2400) % 2 == 0) ? 0.9 : 0.1;
+            signal.setSample (0, n, (float) (steps * std::sin (twoPi * 100.0 * t)));
+
+            //1 kHz com envelope lento
+            const double envelope = 0.5 + 0.45 * std::sin (twoPi * 4.0 * t);
+            signal.setSample (1, n, (float) (envelope * std::sin (twoPi * 1000.0 * t)));
+
+            //Rajadas de ruído
+            seed = seed * 1664525u + 1013904223u;
+            const double noise = ((seed >> 8) / 8388608.0) - 1.0;
+            signal.setSample (2, n, (float) (((n / 1000) % 3 == 0 ? 0.8 : 0.05) * noise));
+
+            //Sweep de 50 Hz a 10 kHz
+            const double phase = twoPi * 50.0 * (std::pow (200.0, t / 0.25) - 1.0) * 0.25 / std::log (200.0);
+            signal.setSample (3, n, (float) (0.7 * std::sin (phase)));
+        }
+
+        return signal;
+    }
+
+    struct Partition
+    {
+        juce::String name;
+        std::vector<int> blockSizes;
+        int preparedBlockSize;
+        bool nonRealtime;
+    };
+
+    std::vector<int> fixedBlocks (int blockSize)
+    {
+        std::vector<int> sizes;
+
+        for (int start = 0; start < numSamples; start += blockSize)
+            sizes.push_back (juce::jmin (blockSize, numSamples - start));
+
+        return sizes;
+    }
+
+    std::vector<int> randomBlocks (juce::int64 seed, int maxBlockSize)
+    {
+        juce::Random random (seed);
+        std::vector<int> sizes;
+
+        for (int start = 0; start < numSamples;)
+        {
+            const int size = juce::jmin (1 + random.nextInt (maxBlockSize), numSamples - start);
+            sizes.push_back (size);
+            start += size;
+        }
+
+        return sizes;
+    }
+
+    std::vector<Partition> makePartitions()
+    {
+        return {
+            { "fixed 32",                 fixedBlocks (32),           32,         false },
+            { "fixed 512",                fixedBlocks (512),          512,        false },
+            { "random",                   randomBlocks (1, 1500),     1500,       false },
+            { "random, over prepared",    randomBlocks (2, 3000),     256,        false },
+            { "single block",             { numSamples },             numSamples, false },
+            { "4096 over prepared 256",   fixedBlocks (4096),         256,        false },
+            { "single block, parallel",   { numSamples },             numSamples, true },
+            { "random, parallel",         randomBlocks (3, 6000),     6000,       true },
+        };
+    }
+
+    juce::AudioBuffer<float> render (const juce::AudioBuffer<float>& input, const CompressorParams& params, const Partition& partition)
+    {
+        KeblexCompAudioProcessor processor;
+        processor.setPlayConfigDetails (numChannels, numChannels, sampleRate, partition.preparedBlockSize);
+
+        //Tem de ser antes do prepareToPlay, como nos hosts, para o pool de threads ser criado
+        processor.setNonRealtime (partition.nonRealtime);
+        processor.prepareToPlay (sampleRate, partition.preparedBlockSize);
+        processor.setCurrentParams (params);
+
+        juce::AudioBuffer<float> output (numChannels, numSamples);
+        juce::MidiBuffer midi;
+        int start = 0;
+
+        for (int size : partition.blockSizes)
+        {
+            juce::AudioBuffer<float> block (numChannels, size);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                block.copyFrom (ch, 0, input, ch, start, size);
+
+            processor.processBlock (block, midi);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                output.copyFrom (ch, start, block, ch, 0, size);
+
+            start += size;
+        }
+
+        return output;
+    }
+
+    float maxDifference (const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        float diff = 0.0f;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int n = 0; n < numSamples; ++n)
+                diff = juce::jmax (diff, std::abs (a.getSample (ch, n) - b.getSample (ch, n)));
+
+        return diff;
+    }
+
+    //Ficheiros golden: float32 little endian, canal a canal
+    bool writeGolden (const juce::File& file, const juce::AudioBuffer<float>& output)
+    {
+        file.deleteFile();
+        juce::FileOutputStream out (file);
+
+        if (out.failedToOpen())
+            return false;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int n = 0; n < numSamples; ++n)
+                out.writeFloat (output.getSample (ch, n));
+
+        return true;
+    }
+
+    bool readGolden (const juce::File& file, juce::AudioBuffer<float>& output)
+    {
+        juce::FileInputStream in (file);
+
+        if (in.failedToOpen() || in.getTotalLength() != (juce::int64) numChannels * numSamples * (juce::int64) sizeof (float))
+            return false;
+
+        output.setSize (numChannels, numSamples);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int n = 0; n < numSamples; ++n)
+                output.setSample (ch, n, in.readFloat());
+
+        return true;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    juce::File goldenDir = juce::File::getCurrentWorkingDirectory().getChildFile ("Tests/BlockSizeInvariance/Golden");
+    bool update = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg (argv[i]);
+
+        if (arg == "--update")
+            update = true;
+        else
+            goldenDir = juce::File::getCurrentWorkingDirectory().getChildFile (arg);
+    }
+
+    const juce::AudioBuffer<float> input = makeReferenceSignal();
+    const std::vector<Partition> partitions = makePartitions();
+    int numFailures = 0;
+
+    for (auto mode : { PEAK, RMS })
+    {
+        for (int linkGroupSize : { 1, 2 })
+        {
+            CompressorParams params;
+            params.thresh = -12.0f;
+            params.inGain = 2.0f;
+            params.outGain = -1.0f;
+            params.ratio = 8;
+            params.atkTime = 0.003f;
+            params.relTime = 0.01f;
+            params.detMode = mode;
+            params.linkGroupSize = linkGroupSize;
+
+            const juce::String caseName = juce::String (mode == PEAK ? "peak" : "rms") + "_link" + juce::String (linkGroupSize);
+            const juce::AudioBuffer<float> reference = render (input, params, partitions[0]);
+
+            for (size_t i = 1; i < partitions.size(); ++i)
+            {
+                const float diff = maxDifference (reference, render (input, params, partitions[i]));
+
+                if (diff > partitionTolerance)
+                {
+                    std::cout << "FALHOU " << caseName << " [" << partitions[i].name << "]: diferenca " << diff << std::endl;
+                    ++numFailures;
+                }
+            }
+
+            const juce::File goldenFile = goldenDir.getChildFile (caseName + ".f32");
+
+            if (update)
+            {
+                if (! writeGolden (goldenFile, reference))
+                {
+                    std::cout << "Nao foi possivel escrever " << goldenFile.getFullPathName() << std::endl;
+                    ++numFailures;
+                }
+
+                continue;
+            }
+
+            juce::AudioBuffer<float> golden;
+
+            if (! readGolden (goldenFile, golden))
+            {
+                std::cout << "FALHOU " << caseName << ": golden em falta ou invalido (" << goldenFile.getFullPathName() << ")" << std::endl;
+                ++numFailures;
+                continue;
+            }
+
+            const float diff = maxDifference (reference, golden);
+
+            if (diff > goldenTolerance)
+            {
+                std::cout << "FALHOU " << caseName << " [golden]: diferenca " << diff << std::endl;
+                ++numFailures;
+            }
+        }
+    }
+
+    std::cout << (numFailures == 0 ? "OK" : juce::String (numFailures) + " falhas") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
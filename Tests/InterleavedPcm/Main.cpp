@@ -0,0 +1,267 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 21 Oct 2026 9:14:52am
+
+    Teste do processInterleaved: passa os mesmos sinais por cada PcmFormat
+    (int16 com e sem dither, int24, int32, float32) e compara com a saída do
+    processBlock, dentro da tolerância da quantização de cada formato. Também
+    verifica que os formatos inteiros saturam em vez de dar a volta quando a
+    saída passa de 0 dBFS.
+
+    Uso: InterleavedPcm
+
+    Compila como uma Console Application do JUCE com os mesmos ficheiros de
+    código e módulos do plugin. Devolve 0 se todos os casos passarem.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../PluginProcessor.h"
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numChannels = 4;
+    constexpr int numFrames = 12000;
+
+    //Blocos grandes e nonRealtime, para o processBlock usar o pool e o processInterleaved (sempre em série) não
+    constexpr int blockSize = 4096;
+
+    struct FormatInfo
+    {
+        PcmFormat format;
+        juce::String name;
+        int numBits;    //0 = float32
+        int sampleBytes;
+    };
+
+    //Sinais de referência determinísticos, com partes acima e abaixo do threshold e valores negativos
+    //(para o sign extension dos 24 bits)
+    juce::AudioBuffer<float> makeReferenceSignal()
+    {
+        juce::AudioBuffer<float> signal (numChannels, numFrames);
+        juce::Random random (7);
+        const double twoPi = juce::MathConstants<double>::twoPi;
+
+        for (int n = 0; n < numFrames; ++n)
+        {
+            const double t = n / sampleRate;
+            const double envelope = 0.5 + 0.45 * std::sin (twoPi * 3.0 * t);
+
+            signal.setSample (0, n, (float) (envelope * std::sin (twoPi * 220.0 * t)));
+            signal.setSample (1, n, (float) (0.9 * std::sin (twoPi * 1000.0 * t)));
+            signal.setSample (2, n, (float) (((n / 1500) % 2 == 0 ? 0.7 : 0.02) * (random.nextFloat() * 2.0f - 1.0f)));
+            signal.setSample (3, n, (float) (-0.3 - 0.6 * envelope * std::abs (std::sin (twoPi * 60.0 * t))));
+        }
+
+        return signal;
+    }
+
+    double getFullScale (const FormatInfo& info)
+    {
+        return (double) (1LL << (info.numBits - 1));
+    }
+
+    //Codifica uma sample inteira em little endian, como o processInterleaved espera
+    void writeInt (char* dest, const FormatInfo& info, juce::int64 value)
+    {
+        for (int b = 0; b < info.sampleBytes; ++b)
+            dest[b] = (char) ((value >> (8 * b)) & 0xff);
+    }
+
+    juce::int64 readInt (const char* src, const FormatInfo& info)
+    {
+        juce::uint64 value = 0;
+
+        for (int b = 0; b < info.sampleBytes; ++b)
+            value |= (juce::uint64) (juce::uint8) src[b] << (8 * b);
+
+        //Sign extension a partir do bit mais alto do formato
+        const int shift = 64 - info.numBits;
+        return (juce::int64) (value << shift) >> shift;
+    }
+
+    //Arredonda a entrada para a grelha do formato: o processBlock tem de ver exatamente os mesmos valores
+    juce::AudioBuffer<float> quantiseInput (const juce::AudioBuffer<float>& input, const FormatInfo& info)
+    {
+        juce::AudioBuffer<float> quantised (input);
+
+        if (info.numBits == 0)
+            return quantised;
+
+        const double fullScale = getFullScale (info);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int n = 0; n < numFrames; ++n)
+                quantised.setSample (ch, n, (float) (juce::jlimit (-fullScale, fullScale - 1.0, std::round (input.getSample (ch, n) * fullScale)) / fullScale));
+
+        return quantised;
+    }
+
+    void prepare (KeblexCompAudioProcessor& processor, const CompressorParams& params)
+    {
+        processor.setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+        processor.setNonRealtime (true);
+        processor.prepareToPlay (sampleRate, blockSize);
+        processor.setCurrentParams (params);
+    }
+
+    juce::AudioBuffer<float> renderBlocks (const juce::AudioBuffer<float>& input, const CompressorParams& params)
+    {
+        KeblexCompAudioProcessor processor;
+        prepare (processor, params);
+
+        juce::AudioBuffer<float> output (numChannels, numFrames);
+        juce::MidiBuffer midi;
+
+        for (int start = 0; start < numFrames; start += blockSize)
+        {
+            const int size = juce::jmin (blockSize, numFrames - start);
+            juce::AudioBuffer<float> block (numChannels, size);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                block.copyFrom (ch, 0, input, ch, start, size);
+
+            processor.processBlock (block, midi);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                output.copyFrom (ch, start, block, ch, 0, size);
+        }
+
+        return output;
+    }
+
+    std::vector<char> renderInterleaved (const juce::AudioBuffer<float>& input, const CompressorParams& params,
+                                         const FormatInfo& info, bool dither)
+    {
+        std::vector<char> data ((size_t) (numFrames * numChannels * info.sampleBytes));
+
+        for (int n = 0; n < numFrames; ++n)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                char* dest = data.data() + (size_t) ((n * numChannels + ch) * info.sampleBytes);
+
+                if (info.numBits == 0)
+                    *reinterpret_cast<float*> (dest) = input.getSample (ch, n);
+                else
+                    writeInt (dest, info, (juce::int64) std::round (input.getSample (ch, n) * getFullScale (info)));
+            }
+        }
+
+        KeblexCompAudioProcessor processor;
+        prepare (processor, params);
+
+        for (int start = 0; start < numFrames; start += blockSize)
+        {
+            processor.processInterleaved (data.data() + (size_t) (start * numChannels * info.sampleBytes), info.format,
+                                          numChannels, juce::jmin (blockSize, numFrames - start), dither);
+        }
+
+        return data;
+    }
+
+    //Maior diferença, em LSB do formato (em valor absoluto no float32), entre a saída intercalada e a do
+    //processBlock já quantizada e saturada como a de um conversor ideal
+    double maxDifference (const std::vector<char>& data, const juce::AudioBuffer<float>& reference, const FormatInfo& info)
+    {
+        double diff = 0.0;
+
+        for (int n = 0; n < numFrames; ++n)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const char* src = data.data() + (size_t) ((n * numChannels + ch) * info.sampleBytes);
+
+                if (info.numBits == 0)
+                {
+                    diff = juce::jmax (diff, (double) std::abs (*reinterpret_cast<const float*> (src) - reference.getSample (ch, n)));
+                    continue;
+                }
+
+                const double fullScale = getFullScale (info);
+                const double expected = juce::jlimit (-fullScale, fullScale - 1.0, (double) reference.getSample (ch, n) * fullScale);
+                diff = juce::jmax (diff, std::abs ((double) readInt (src, info) - expected));
+            }
+        }
+
+        return diff;
+    }
+}
+
+int main()
+{
+    const std::vector<FormatInfo> formats = {
+        { PCM_INT16,   "int16",   16, 2 },
+        { PCM_INT24,   "int24",   24, 3 },
+        { PCM_INT32,   "int32",   32, 4 },
+        { PCM_FLOAT32, "float32", 0,  4 },
+    };
+
+    CompressorParams normal;
+    normal.thresh = -12.0f;
+    normal.inGain = 2.0f;
+    normal.outGain = -1.0f;
+    normal.ratio = 8;
+    normal.atkTime = 0.003f;
+    normal.relTime = 0.01f;
+    normal.linkGroupSize = 2;
+
+    //Ganho de saída alto: os picos passam de 0 dBFS e os formatos inteiros têm de saturar
+    CompressorParams clipping = normal;
+    clipping.thresh = -3.0f;
+    clipping.ratio = 2;
+    clipping.outGain = 9.0f;
+
+    const juce::AudioBuffer<float> input = makeReferenceSignal();
+    int numFailures = 0;
+
+    auto check = [&] (const juce::String& caseName, double diff, double tolerance)
+    {
+        if (diff > tolerance)
+        {
+            std::cout << "FALHOU " << caseName << ": diferenca " << diff << " (tolerancia " << tolerance << ")" << std::endl;
+            ++numFailures;
+        }
+    };
+
+    for (auto* params : { &normal, &clipping })
+    {
+        const juce::String paramsName = (params == &normal) ? "normal" : "clipping";
+
+        for (auto& info : formats)
+        {
+            const juce::AudioBuffer<float> quantised = quantiseInput (input, info);
+            const juce::AudioBuffer<float> reference = renderBlocks (quantised, *params);
+            const std::vector<char> plain = renderInterleaved (quantised, *params, info, false);
+
+            if (info.numBits == 0)
+            {
+                //Mesmas contas, só muda o acesso com salto: tem de ser exatamente igual
+                check (paramsName + " " + info.name, maxDifference (plain, reference, info), 0.0);
+                continue;
+            }
+
+            //A entrada está na grelha do formato, por isso as contas em float são as mesmas do processBlock
+            //e só fica o arredondamento da escrita: meio LSB
+            const double roundingTolerance = 0.5 + 1.0e-6;
+            check (paramsName + " " + info.name, maxDifference (plain, reference, info), roundingTolerance);
+
+            //Dither TPDF: até mais 1 LSB, e a saída tem de mudar em relação à versão sem dither
+            const std::vector<char> dithered = renderInterleaved (quantised, *params, info, true);
+            check (paramsName + " " + info.name + " dither", maxDifference (dithered, reference, info), roundingTolerance + 1.0);
+
+            if (info.numBits == 16 && dithered == plain)
+            {
+                std::cout << "FALHOU " << paramsName << " int16 dither: saida igual a sem dither" << std::endl;
+                ++numFailures;
+            }
+        }
+    }
+
+    std::cout << (numFailures == 0 ? "OK" : juce::String (numFailures) + " falhas") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 21 Oct 2026 2:37:05pm
+
+    Testes do LoudnessAnalyser e do applyLoudnessTarget:
+     - seno de 1 kHz a -20 dBFS: -23.0 LUFS em mono e -20.0 LUFS em estéreo
+       (BS.1770, tolerância de 0.1 LU como nos sinais do EBU Tech 3341)
+     - seno de 12 kHz a 48 kHz com fase de 45°: o true peak (~0 dBTP) tem de
+       ficar bem acima do sample peak (-3.01 dB)
+     - análise em pedaços pequenos (em paralelo) igual à análise num só pedaço
+     - applyLoudnessTarget seguido do render: a saída fica no alvo
+
+    Uso: Loudness
+
+    Compila como uma Console Application do JUCE com os mesmos ficheiros de
+    código e módulos do plugin. Devolve 0 se todos os casos passarem.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../PluginProcessor.h"
+#include "../../LoudnessAnalyser.h"
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+
+    juce::AudioBuffer<float> makeSine (int numChannels, double seconds, double frequency, double amplitude, double phase)
+    {
+        const int numSamples = (int) (seconds * sampleRate);
+        juce::AudioBuffer<float> signal (numChannels, numSamples);
+        const double twoPi = juce::MathConstants<double>::twoPi;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int n = 0; n < numSamples; ++n)
+                signal.setSample (ch, n, (float) (amplitude * std::sin (twoPi * frequency * n / sampleRate + phase)));
+
+        return signal;
+    }
+
+    //Programa com loudness variável: troços de 1 kHz e de ruído a níveis diferentes, para o gating e o LRA contarem
+    juce::AudioBuffer<float> makeProgramme()
+    {
+        const int numSamples = (int) (60.0 * sampleRate);
+        juce::AudioBuffer<float> signal (2, numSamples);
+        juce::Random random (11);
+        const double twoPi = juce::MathConstants<double>::twoPi;
+        const double levels[] = { 0.3, 0.05, 0.6, 0.01, 0.2 };
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const double level = levels[(n / (int) (7.0 * sampleRate)) % 5];
+            const double tone = std::sin (twoPi * 1000.0 * n / sampleRate);
+
+            signal.setSample (0, n, (float) (level * tone));
+            signal.setSample (1, n, (float) (level * (random.nextFloat() * 2.0f - 1.0f)));
+        }
+
+        return signal;
+    }
+
+    juce::AudioBuffer<float> render (const juce::AudioBuffer<float>& input, const CompressorParams& params)
+    {
+        KeblexCompAudioProcessor processor;
+        processor.setPlayConfigDetails (input.getNumChannels(), input.getNumChannels(), sampleRate, 1024);
+        processor.prepareToPlay (sampleRate, 1024);
+        processor.setCurrentParams (params);
+
+        juce::AudioBuffer<float> output (input);
+        juce::MidiBuffer midi;
+        processor.processBlock (output, midi);
+        return output;
+    }
+}
+
+int main()
+{
+    int numFailures = 0;
+
+    auto check = [&] (const juce::String& caseName, double value, double expected, double tolerance)
+    {
+        if (! (std::abs (value - expected) <= tolerance))
+        {
+            std::cout << "FALHOU " << caseName << ": " << value << " (esperado " << expected << " +- " << tolerance << ")" << std::endl;
+            ++numFailures;
+        }
+    };
+
+    LoudnessAnalyser analyser;
+
+    //Valores de referência do BS.1770
+    check ("1 kHz -20 dBFS mono", analyser.analyse (makeSine (1, 20.0, 1000.0, 0.1, 0.0), sampleRate).integratedLufs, -23.0, 0.1);
+    check ("1 kHz -20 dBFS estereo", analyser.analyse (makeSine (2, 20.0, 1000.0, 0.1, 0.0), sampleRate).integratedLufs, -20.0, 0.1);
+
+    //As samples caem sempre a +-45° do pico: sample peak de -3.01 dB, true peak de 0 dBTP
+    //(tolerância do EBU Tech 3341 para o true peak: +0.2 / -0.4 dB)
+    const double truePeak = analyser.analyse (makeSine (1, 5.0, 12000.0, 1.0, juce::MathConstants<double>::pi / 4.0), sampleRate).truePeakDb;
+    check ("true peak 12 kHz 45 graus", truePeak, -0.1, 0.3);
+
+    //Pedaços de 100 ms com pre-roll contra o ficheiro inteiro num só pedaço
+    const juce::AudioBuffer<float> programme = makeProgramme();
+    const LoudnessAnalysis single = LoudnessAnalyser (1000000).analyse (programme, sampleRate);
+    const LoudnessAnalysis chunked = LoudnessAnalyser (1).analyse (programme, sampleRate);
+
+    check ("pedacos: integrated", chunked.integratedLufs, single.integratedLufs, 0.01);
+    check ("pedacos: loudness range", chunked.loudnessRange, single.loudnessRange, 0.01);
+    check ("pedacos: true peak", chunked.truePeakDb, single.truePeakDb, 1.0e-3);
+    check ("pedacos: blocos", (double) chunked.momentaryEnergies.size(), (double) single.momentaryEnergies.size(), 0.0);
+
+    //applyLoudnessTarget mede o resultado com um render, por isso a saída tem de acertar no alvo
+    for (auto mode : { PEAK, RMS })
+    {
+        for (float target : { -16.0f, -23.0f })
+        {
+            KeblexCompAudioProcessor processor;
+            processor.setPlayConfigDetails (2, 2, sampleRate, 1024);
+            processor.prepareToPlay (sampleRate, 1024);
+
+            CompressorParams params;
+            params.inGain = 0.0f;
+            params.ratio = 10;
+            params.atkTime = 0.001f;
+            params.relTime = 0.01f;
+            params.detMode = mode;
+            processor.setCurrentParams (params);
+
+            const juce::String caseName = juce::String (mode == PEAK ? "peak" : "rms") + " alvo " + juce::String ((int) target);
+
+            if (! processor.applyLoudnessTarget (single, programme, sampleRate, target))
+            {
+                std::cout << "FALHOU " << caseName << ": applyLoudnessTarget devolveu false" << std::endl;
+                ++numFailures;
+                continue;
+            }
+
+            const double measured = analyser.analyse (render (programme, processor.getCurrentParams()), sampleRate).integratedLufs;
+            check (caseName, measured, target, 0.05);
+        }
+    }
+
+    std::cout << (numFailures == 0 ? "OK" : juce::String (numFailures) + " falhas") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 19 Oct 2026 11:58:09am
+
+    Ferramenta de linha de comandos que volta a passar um ficheiro gravado
+    com KeblexCompAudioProcessor::startCapture() pelo processador, para
+    analisar offline (profiler, benchmark) os padrões de blocos do host.
+
+    Uso: ReplayCapture <ficheiro de captura> [repetições]
+
+    Compila como uma Console Application do JUCE com os mesmos ficheiros de
+    código e módulos do plugin.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../PluginProcessor.h"
+#include "../../BlockCapture.h"
+
+int main (int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Uso: ReplayCapture <ficheiro de captura> [repeticoes]" << std::endl;
+        return 1;
+    }
+
+    const juce::File file = juce::File::getCurrentWorkingDirectory().getChildFile (juce::String (argv[1]));
+    const int repeats = argc > 2 ? juce::jmax (1, juce::String (argv[2]).getIntValue()) : 1;
+
+    CaptureReplayer replayer;
+
+    if (! replayer.open (file))
+    {
+        std::cerr << "Nao foi possivel ler a captura: " << file.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::cout << replayer.getNumBlocks() << " blocos, " << replayer.getNumChannels() << " canais, "
+              << replayer.getSampleRate() << " Hz, blocos preparados de " << replayer.getMaxBlockSize()
+              << " amostras (maior bloco: " << replayer.getMaxReplayBlockSize() << ")" << std::endl;
+
+    //Blocos em falta mudam o estado do compressor entre blocos: a reprodução deixa de ser igual à sessão original
+    if (replayer.getNumDroppedBlocks() > 0 || replayer.getNumMissingBlocks() > 0)
+    {
+        std::cerr << "AVISO: " << replayer.getNumDroppedBlocks() << " blocos descartados durante a captura (FIFO cheio), "
+                  << replayer.getNumMissingBlocks() << " em falta entre os blocos reproduzidos." << std::endl
+                  << "AVISO: a reproducao salta esses blocos e repoe o estado gravado no bloco seguinte." << std::endl;
+    }
+
+    KeblexCompAudioProcessor processor;
+
+    for (int i = 0; i < repeats; ++i)
+    {
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        replayer.replay (processor);
+        const auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+        std::cout << "Repeticao " << (i + 1) << ": " << elapsed * 1000.0 << " ms" << std::endl;
+    }
+
+    return 0;
+}